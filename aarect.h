@@ -0,0 +1,61 @@
+#ifndef AARECT_H
+#define AARECT_H
+
+#include "rtweekend.h"
+#include "hittable.h"
+
+/* Axis-aligned rectangle in the plane y=k. Mostly useful as an area light (e.g. a ceiling lamp). */
+class xz_rect : public hittable {
+    public:
+        double x0, x1, z0, z1, k;
+        shared_ptr<material> mp;
+
+    public:
+        xz_rect() {}
+        xz_rect(double _x0, double _x1, double _z0, double _z1, double _k, shared_ptr<material> mat)
+            : x0(_x0), x1(_x1), z0(_z0), z1(_z1), k(_k), mp(mat) {};
+
+        virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const override;
+        virtual double pdf_value(const point3& o, const vec3& v) const override;
+        virtual vec3 random(const point3& o) const override;
+};
+
+bool xz_rect::hit(const ray& r, double t_min, double t_max, hit_record& rec) const {
+    /* Where the ray crosses the plane y=k. */
+    auto t = (k-r.origin().y()) / r.direction().y();
+    if (t < t_min || t > t_max)
+        return false;
+
+    auto x = r.origin().x() + t*r.direction().x();
+    auto z = r.origin().z() + t*r.direction().z();
+    if (x < x0 || x > x1 || z < z0 || z > z1)
+        return false;
+
+    rec.t = t;
+    rec.p = r.at(t);
+    rec.set_face_normal(r, vec3(0,1,0));
+    rec.mat_ptr = mp;
+
+    return true;
+}
+
+/* Uniform over the area, converted to solid angle: dA = dw * distance^2 / cosine. */
+double xz_rect::pdf_value(const point3& o, const vec3& v) const {
+    hit_record rec;
+    if (!this->hit(ray(o,v), 0.001, infinity, rec))
+        return 0;
+
+    auto area = (x1-x0)*(z1-z0);
+    auto distance_squared = rec.t * rec.t * v.length_squared();
+    auto cosine = fabs(dot(v, rec.normal) / v.length());
+
+    return distance_squared / (cosine * area);
+}
+
+/* Direction from o to a random point on the rectangle. */
+vec3 xz_rect::random(const point3& o) const {
+    auto random_point = point3(random_double(x0,x1), k, random_double(z0,z1));
+    return random_point - o;
+}
+
+#endif
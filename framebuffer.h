@@ -0,0 +1,67 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include "color.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/* Running sum of samples for every pixel, for progressive rendering: keep adding passes of
+one sample per pixel and write out the average whenever we like. */
+class framebuffer {
+    public:
+        int width;
+        int height;
+        /* Samples per pixel accumulated so far. */
+        int samples;
+        std::vector<color> pixels;
+
+    public:
+        framebuffer(int w, int h) : width(w), height(h), samples(0), pixels(w*h) {}
+
+        /* Throw away everything accumulated so far, e.g. because the camera moved. */
+        void reset() {
+            std::fill(pixels.begin(), pixels.end(), color(0,0,0));
+            samples = 0;
+        }
+
+        /* Row 0 is the bottom of the image, same as j in the render loop. */
+        color& at(int i, int j) {return pixels[j*width+i];}
+        const color& at(int i, int j) const {return pixels[j*width+i];}
+
+        bool write_ppm(const std::string& filename, int out_width, int out_height) const;
+};
+
+/* Write the average so far as a out_width x out_height image (nearest neighbour scaling, so a
+low resolution buffer shows up as big blocks). Written to a temporary file and renamed over
+filename, so an image viewer never sees a half written file. */
+bool framebuffer::write_ppm(const std::string& filename, int out_width, int out_height) const {
+    if (samples == 0)
+        return false;
+
+    std::string tmp = filename + ".tmp";
+    {
+        std::ofstream out(tmp);
+        if (!out)
+            return false;
+
+        out << "P3\n" << out_width << ' ' << out_height << "\n255\n";
+        for (int j=out_height-1;j>=0;j--){
+            int src_j = j*height/out_height;
+            for (int i=0;i<out_width;i++){
+                int src_i = i*width/out_width;
+                write_color(out, at(src_i,src_j), samples);
+            }
+        }
+
+        if (!out)
+            return false;
+    }
+
+    return std::rename(tmp.c_str(), filename.c_str()) == 0;
+}
+
+#endif
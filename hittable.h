@@ -29,7 +29,24 @@ class hittable {
         /* virtual func() = 0: pure virtual function, which means that it cannot be implement by the base (this) class. 
         When a pure virtual method exists, the class is "abstract" & cannot be instantiated on its own. */
         virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const = 0;
-    
+
+        /* Shadow ray query: is there anything at all in (t_min,t_max)? Unlike hit(), we don't care
+        which object is the closest, so containers can stop at the first occluder. */
+        virtual bool hit_any(const ray& r, double t_min, double t_max) const {
+            hit_record rec;
+            return hit(r,t_min,t_max,rec);
+        }
+
+        /* Light sampling. pdf_value() is the solid angle density of sampling direction v from o,
+        random() returns such a direction. Objects that can't be sampled return a pdf of 0. */
+        virtual double pdf_value(const point3& o, const vec3& v) const {
+            return 0.0;
+        }
+
+        virtual vec3 random(const point3& o) const {
+            return vec3(1,0,0);
+        }
+
 };
 
 #endif
\ No newline at end of file
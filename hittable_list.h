@@ -22,6 +22,9 @@ class hittable_list : public hittable {
         void add(shared_ptr<hittable> object) {objects.push_back(object);}
 
         virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const override;
+        virtual bool hit_any(const ray& r, double t_min, double t_max) const override;
+        virtual double pdf_value(const point3& o, const vec3& v) const override;
+        virtual vec3 random(const point3& o) const override;
 };
 
 /* Iterate over objects to see which one will the ray hit first
@@ -42,4 +45,34 @@ bool hittable_list::hit(const ray& r, double t_min, double t_max, hit_record& re
     return hit_anything;
 }
 
+/* No need to keep looking for the closest hit, the first one is enough to block the ray. */
+bool hittable_list::hit_any(const ray& r, double t_min, double t_max) const {
+    for (const auto& object:objects){
+        if (object->hit_any(r,t_min,t_max))
+            return true;
+    }
+
+    return false;
+}
+
+/* Pick one of the objects uniformly, so the density is the average of their densities. */
+double hittable_list::pdf_value(const point3& o, const vec3& v) const {
+    if (objects.empty())
+        return 0.0;
+
+    auto sum = 0.0;
+    for (const auto& object:objects)
+        sum += object->pdf_value(o,v);
+
+    return sum / objects.size();
+}
+
+vec3 hittable_list::random(const point3& o) const {
+    if (objects.empty())
+        return vec3(1,0,0);
+
+    auto int_size = static_cast<int>(objects.size());
+    return objects[random_int(0,int_size-1)]->random(o);
+}
+
 #endif
\ No newline at end of file
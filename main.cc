@@ -3,11 +3,18 @@
 #include "color.h"
 #include "hittable_list.h"
 #include "sphere.h"
+#include "aarect.h"
 #include "camera.h"
 #include "vec3.h"
 #include "material.h"
+#include "framebuffer.h"
 
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <string>
+#include <thread>
 
 double hit_sphere(const point3& center, double radius, const ray& r){
     /* Vector from origin to the center of the circle. */
@@ -25,30 +32,19 @@ double hit_sphere(const point3& center, double radius, const ray& r){
     }
 }
 
-/* Return the color of the ray. */
-color ray_color(const ray& r, const hittable& world, int depth) {
-    hit_record rec;
+/* Everything ray_color needs to know about the world. Emissive objects go in both lists:
+world for intersection, lights so that they can be sampled directly. */
+struct scene {
+    hittable_list world;
+    hittable_list lights;
+    /* Escaped rays see the sky gradient if true, black otherwise. */
+    bool sky = true;
+};
 
-    // If we've exceeded the ray bounce limit, no more light is gathered. 
-    if (depth <= 0)
+color background(const ray& r, const scene& sc) {
+    if (!sc.sky)
         return color(0,0,0);
 
-    /* t_max = infinity. */
-    /* 0.001: ignore hits very near zero. (to fix the shadow acne problem) */
-    if (world.hit(r,0.001,infinity,rec)){
-        ray scattered;
-        color attenuation;
-        /* Note: recursion is introduced here. */
-        /* ray(rec.p,target-rec.p) goes from the intersection point on the surface of the 
-        sphere to the random point inside the sphere. So it is the bounced ray. */
-        /* Note: because of this, the scanlines at the bottom (where there can be a lot of bouncing)
-        take much longer than those at the top. */
-        if (rec.mat_ptr->scatter(r,rec,attenuation,scattered))
-            return attenuation*ray_color(scattered,world,depth-1);
-        return color(0,0,0);
-    }
-    
-    /* The background. */
     /* Get the direction of the ray. */
     vec3 unit_direction = unit_vector(r.direction());
     /* Parameterization to create a gradient for the background. 
@@ -58,7 +54,226 @@ color ray_color(const ray& r, const hittable& world, int depth) {
     return (1.0-t)*color(1.0,1.0,1.0)+t*color(0.5,0.7,1.0);
 }
 
-int main(){
+/* Next-event estimation: instead of waiting for a bounced ray to hit a (small) light by chance, 
+pick a direction towards one of the lights and check with a shadow ray that nothing is in the way. */
+color sample_lights(const hit_record& rec, const scene& sc) {
+    vec3 to_light = sc.lights.random(rec.p);
+    auto light_pdf = sc.lights.pdf_value(rec.p, to_light);
+    if (light_pdf <= 0)
+        return color(0,0,0);
+
+    color f = rec.mat_ptr->eval(rec, to_light);
+    if (f.length_squared() == 0)
+        return color(0,0,0);
+
+    /* Find the point on the light (lights can overlap, so the closest one), then any occluder 
+    before it blocks the light. */
+    ray shadow_ray(rec.p, to_light);
+    hit_record light_rec;
+    if (!sc.lights.hit(shadow_ray, 0.001, infinity, light_rec))
+        return color(0,0,0);
+    if (sc.world.hit_any(shadow_ray, 0.001, light_rec.t - 0.001))
+        return color(0,0,0);
+
+    /* The same direction could have been picked by scatter() too. Weigh the two so that the 
+    light isn't counted twice (see the emitted term in ray_color). */
+    auto weight = power_heuristic(light_pdf, rec.mat_ptr->scattering_pdf(rec, to_light));
+    return weight * f * light_rec.mat_ptr->emitted(shadow_ray, light_rec) / light_pdf;
+}
+
+/* Return the color of the ray. */
+/* specular_bounce: r was not picked by a material that light sampling can handle (camera rays, metal, glass).
+scatter_pdf: the density with which the previous material picked r, for multiple importance sampling. */
+color ray_color(const ray& r, const scene& sc, int depth, bool specular_bounce = true, double scatter_pdf = 0) {
+    hit_record rec;
+
+    // If we've exceeded the ray bounce limit, no more light is gathered. 
+    if (depth <= 0)
+        return color(0,0,0);
+
+    /* t_max = infinity. */
+    /* 0.001: ignore hits very near zero. (to fix the shadow acne problem) */
+    if (!sc.world.hit(r,0.001,infinity,rec))
+        return background(r, sc);
+
+    color emitted = rec.mat_ptr->emitted(r, rec);
+    /* If the previous vertex also sampled the lights, this light was already (partially) counted 
+    there, so only take the bounced ray's share of it. */
+    if (!specular_bounce && emitted.length_squared() > 0) {
+        auto light_pdf = sc.lights.pdf_value(r.origin(), r.direction());
+        emitted *= power_heuristic(scatter_pdf, light_pdf);
+    }
+
+    ray scattered;
+    color attenuation;
+    /* Note: recursion is introduced here. */
+    /* ray(rec.p,target-rec.p) goes from the intersection point on the surface of the 
+    sphere to the random point inside the sphere. So it is the bounced ray. */
+    /* Note: because of this, the scanlines at the bottom (where there can be a lot of bouncing)
+    take much longer than those at the top. */
+    if (!rec.mat_ptr->scatter(r,rec,attenuation,scattered))
+        return emitted;
+
+    auto pdf = rec.mat_ptr->scattering_pdf(rec, scattered.direction());
+    color direct = pdf > 0 ? sample_lights(rec, sc) : color(0,0,0);
+
+    return emitted + direct + attenuation*ray_color(scattered, sc, depth-1, pdf <= 0, pdf);
+}
+
+/* The four spheres from the book, lit by the sky. */
+scene book_scene() {
+    scene sc;
+
+    auto material_ground = make_shared<lambertian>(color(0.8,0.8,0));
+    auto material_center = make_shared<lambertian>(color(0.1,0.2,0.5));
+    auto material_left = make_shared<dielectric>(1.5);
+    auto material_right = make_shared<metal>(color(0.8,0.6,0.2),0.0);
+
+    /* Large sphere: ground */
+    sc.world.add(make_shared<sphere>(point3(0.0,-100.5,-1.0),100.0,material_ground));
+    sc.world.add(make_shared<sphere>(point3(0.0,0.0,-1.0),0.5,material_center));
+    sc.world.add(make_shared<sphere>(point3(-1.0,0.0,-1.0),-0.4,material_left));
+    sc.world.add(make_shared<sphere>(point3(1.0,0.0,-1.0),0.5,material_right));
+
+    return sc;
+}
+
+/* Same spheres at night, lit only by a small sphere light and a ceiling panel. 
+Without light sampling this takes thousands of samples per pixel to clean up. */
+scene small_light_scene() {
+    scene sc = book_scene();
+    sc.sky = false;
+
+    auto bulb = make_shared<sphere>(point3(0.0,1.5,-0.5),0.1,make_shared<diffuse_light>(color(60,55,45)));
+    auto panel = make_shared<xz_rect>(-1.5,-1.0,-1.5,-1.0,2.0,make_shared<diffuse_light>(color(8,8,10)));
+
+    sc.world.add(bulb);
+    sc.world.add(panel);
+    sc.lights.add(bulb);
+    sc.lights.add(panel);
+
+    return sc;
+}
+
+/* Where the camera is, kept apart from the camera itself so that preview mode can reload it from a file. */
+struct view {
+    point3 lookfrom;
+    point3 lookat;
+    vec3 vup;
+    double vfov;
+    double aperture;
+
+    camera make_camera(double aspect_ratio) const {
+        auto dist_to_focus = (lookfrom-lookat).length();
+        return camera(lookfrom, lookat, vup, vfov, aspect_ratio, aperture, dist_to_focus);
+    }
+};
+
+/* Camera file: lookfrom (x y z), lookat (x y z), vfov, aperture, separated by whitespace. 
+v is left untouched if the file can't be parsed (e.g. the editor is halfway through saving it). */
+bool read_view(const std::string& filename, view& v) {
+    std::ifstream in(filename);
+    view next = v;
+    if (!(in >> next.lookfrom[0] >> next.lookfrom[1] >> next.lookfrom[2]
+             >> next.lookat[0] >> next.lookat[1] >> next.lookat[2]
+             >> next.vfov >> next.aperture))
+        return false;
+
+    v = next;
+    return true;
+}
+
+void write_view(const std::string& filename, const view& v) {
+    std::ofstream out(filename);
+    out << v.lookfrom << '\n' << v.lookat << '\n' << v.vfov << '\n' << v.aperture << '\n';
+}
+
+/* Add one sample to every pixel of fb. */
+void render_pass(framebuffer& fb, const camera& cam, const scene& sc, int max_depth) {
+    for (int j=0;j<fb.height;j++){
+        for (int i=0;i<fb.width;i++){
+            auto u = (i+random_double()) / (fb.width-1);
+            auto v = (j+random_double()) / (fb.height-1);
+            fb.at(i,j) += ray_color(cam.get_ray(u,v), sc, max_depth);
+        }
+    }
+    fb.samples++;
+}
+
+/* Preview mode: instead of one full render, keep adding passes of one sample per pixel and rewrite 
+output every now and then, so it can be left open in an image viewer that reloads on change. 
+Edits to camera_file restart the accumulation with the new camera. The scene is built once and reused. */
+void preview(const scene& sc, view v, const std::string& camera_file, const std::string& output,
+             int image_width, int image_height, int samples_per_pixel, int max_depth) {
+    namespace fs = std::filesystem;
+    using clock = std::chrono::steady_clock;
+
+    /* The first pass after a camera change is this many times smaller in each direction. */
+    const int coarse_factor = 4;
+    const auto write_interval = std::chrono::milliseconds(500);
+
+    const auto aspect_ratio = double(image_width) / image_height;
+    framebuffer coarse(image_width/coarse_factor, image_height/coarse_factor);
+    framebuffer fine(image_width, image_height);
+
+    /* Give the user something to edit. */
+    if (!fs::exists(camera_file))
+        write_view(camera_file, v);
+
+    std::cerr << "Preview: watching " << camera_file << ", writing " << output << " (Ctrl-C to stop)\n";
+
+    camera cam = v.make_camera(aspect_ratio);
+    fs::file_time_type last_modified;
+    bool camera_changed = true;
+    auto last_write = clock::now();
+
+    while (true) {
+        std::error_code ec;
+        auto modified = fs::last_write_time(camera_file, ec);
+        if (!ec && modified != last_modified) {
+            last_modified = modified;
+            if (read_view(camera_file, v))
+                camera_changed = true;
+            else
+                std::cerr << "\nCould not parse " << camera_file << ", keeping the previous camera.\n";
+        }
+
+        if (camera_changed) {
+            camera_changed = false;
+            auto start = clock::now();
+
+            cam = v.make_camera(aspect_ratio);
+            coarse.reset();
+            render_pass(coarse, cam, sc, max_depth);
+            coarse.write_ppm(output, image_width, image_height);
+            fine.reset();
+
+            last_write = clock::now();
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(last_write-start).count();
+            std::cerr << "\rCamera updated, first pass in " << ms << " ms        " << std::flush;
+            continue;
+        }
+
+        /* Converged: just wait for the next camera change. */
+        if (fine.samples >= samples_per_pixel) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+
+        render_pass(fine, cam, sc, max_depth);
+
+        /* Write often early on (1, 2, 4, ... samples), where each pass makes a visible difference, 
+        then at most every write_interval. */
+        bool power_of_two = (fine.samples & (fine.samples-1)) == 0;
+        if (power_of_two || fine.samples == samples_per_pixel || clock::now()-last_write >= write_interval) {
+            fine.write_ppm(output, image_width, image_height);
+            last_write = clock::now();
+            std::cerr << "\rSamples per pixel: " << fine.samples << "        " << std::flush;
+        }
+    }
+}
+
+int main(int argc, char* argv[]){
 
     // Image
     const auto aspect_ratio = 16.0 / 9.0;
@@ -68,24 +283,17 @@ int main(){
     const int max_depth = 50;
 
     // World
-    hittable_list world;
-    
-    auto material_ground = make_shared<lambertian>(color(0.8,0.8,0));
-    auto material_center = make_shared<lambertian>(color(0.1,0.2,0.5));
-    auto material_left = make_shared<dielectric>(1.5);
-    auto material_right = make_shared<metal>(color(0.8,0.6,0.2),0.0);
-
-    /* Large sphere: ground */
-    world.add(make_shared<sphere>(point3(0.0,-100.5,-1.0),100.0,material_ground));
-    world.add(make_shared<sphere>(point3(0.0,0.0,-1.0),0.5,material_center));
-    world.add(make_shared<sphere>(point3(-1.0,0.0,-1.0),-0.4,material_left));
-    world.add(make_shared<sphere>(point3(1.0,0.0,-1.0),0.5,material_right));
+    scene sc;
+    switch (0) {
+        default:
+        case 0: sc = book_scene(); break;
+        case 1: sc = small_light_scene(); break;
+    }
 
     // Camera
     point3 lookfrom(3,3,2);
     point3 lookat(0,0,-1);
     vec3 vup(0,1,0);
-    auto dist_to_focus = (lookfrom-lookat).length();
     auto aperture = 2.0;
 
     // point3 lookfrom(0,0,0);
@@ -94,7 +302,16 @@ int main(){
     // auto dist_to_focus = (lookfrom-lookat).length();
     // auto aperture = 1.0;
     
-    camera cam(lookfrom, lookat, vup, 20, aspect_ratio, aperture, dist_to_focus);
+    view v{lookfrom, lookat, vup, 20, aperture};
+
+    /* ./rt --preview [camera file] */
+    if (argc > 1 && std::string(argv[1]) == "--preview") {
+        std::string camera_file = argc > 2 ? argv[2] : "camera.txt";
+        preview(sc, v, camera_file, "preview.ppm", image_width, image_height, samples_per_pixel, max_depth);
+        return 0;
+    }
+
+    camera cam = v.make_camera(aspect_ratio);
 
     // Render
     std::cout << "P3\n" << image_width << ' ' << image_height << "\n255\n";
@@ -109,7 +326,7 @@ int main(){
                 auto v = (j+random_double()) / (image_height-1);
                 ray r = cam.get_ray(u,v);
                 /* Calculate the color that we see. */
-                pixel_color += ray_color(r,world, max_depth);
+                pixel_color += ray_color(r,sc, max_depth);
             }
 
         write_color(std::cout,pixel_color, samples_per_pixel);
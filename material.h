@@ -9,6 +9,23 @@ struct hit_record;
 class material{
     public:
         virtual bool scatter (const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered) const = 0;
+
+        /* Light given off by the surface itself. Black unless the material is a light. */
+        virtual color emitted(const ray& r_in, const hit_record& rec) const {
+            return color(0,0,0);
+        }
+
+        /* Used for light sampling (next-event estimation): BRDF times cosine for a given outgoing
+        direction, and the density with which scatter() would have picked that direction.
+        Specular materials (metal, glass) can't be hit by a sampled light direction, so they keep the
+        defaults and scatter_pdf = 0 tells the integrator to skip light sampling for them. */
+        virtual color eval(const hit_record& rec, const vec3& direction) const {
+            return color(0,0,0);
+        }
+
+        virtual double scattering_pdf(const hit_record& rec, const vec3& direction) const {
+            return 0;
+        }
 };
 
 
@@ -35,6 +52,18 @@ class lambertian : public material {
         attenuation = albedo;
         return true;
     }
+
+    /* albedo/pi is the Lambertian BRDF. */
+    virtual color eval(const hit_record& rec, const vec3& direction) const override {
+        auto cosine = dot(rec.normal, unit_vector(direction));
+        return cosine < 0 ? color(0,0,0) : albedo*cosine/pi;
+    }
+
+    /* normal + random_unit_vector() is distributed as cos(theta)/pi. */
+    virtual double scattering_pdf(const hit_record& rec, const vec3& direction) const override {
+        auto cosine = dot(rec.normal, unit_vector(direction));
+        return cosine < 0 ? 0 : cosine/pi;
+    }
     
 };
 
@@ -97,6 +126,24 @@ class dielectric : public material{
 
 };
 
+/* Emissive material. Doesn't scatter, only gives off light (from both sides of the surface). */
+class diffuse_light : public material {
+    public:
+        color emit;
+
+    public:
+        diffuse_light(const color& c) : emit(c) {}
+
+    virtual bool scatter(const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered) const override {
+        return false;
+    }
+
+    virtual color emitted(const ray& r_in, const hit_record& rec) const override {
+        return emit;
+    }
+
+};
+
 
 
 
@@ -33,6 +33,20 @@ inline double random_double(double min, double max) {
     return min + (max-min)*random_double();
 }
 
+inline int random_int(int min, int max) {
+    // Returns a random integer in [min,max].
+    return static_cast<int>(random_double(min, max+1));
+}
+
+/* Multiple importance sampling weight for a sample drawn with pdf_a, when the same
+path could also have been drawn by a technique with pdf_b (Veach's power heuristic, beta=2). */
+inline double power_heuristic(double pdf_a, double pdf_b) {
+    auto a2 = pdf_a*pdf_a;
+    auto b2 = pdf_b*pdf_b;
+    if (a2+b2 == 0) return 0;
+    return a2 / (a2+b2);
+}
+
 inline double clamp(double x, double min, double max){
     if (x < min) return min;
     if (x > max) return max;
@@ -3,6 +3,7 @@
 
 #include "hittable.h"
 #include "vec3.h"
+#include "onb.h"
 
 /* Derived from hittable class. */
 class sphere : public hittable {
@@ -15,8 +16,24 @@ class sphere : public hittable {
     sphere(point3 cen, double r, shared_ptr<material> m) : center(cen), radius(r), mat_ptr(m) {};
 
     virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const override;
+    virtual double pdf_value(const point3& o, const vec3& v) const override;
+    virtual vec3 random(const point3& o) const override;
 };
 
+/* Random direction inside the cone that the sphere subtends, around the z axis.
+cos_theta_max is the half-angle of the cone, seen from distance sqrt(distance_squared). */
+inline vec3 random_to_sphere(double radius, double distance_squared) {
+    auto r1 = random_double();
+    auto r2 = random_double();
+    auto z = 1 + r2*(sqrt(1-radius*radius/distance_squared) - 1);
+
+    auto phi = 2*pi*r1;
+    auto x = cos(phi)*sqrt(1-z*z);
+    auto y = sin(phi)*sqrt(1-z*z);
+
+    return vec3(x, y, z);
+}
+
 bool sphere::hit(const ray& r, double t_min, double t_max, hit_record& rec) const {
 
  vec3 oc = r.origin() - center;
@@ -51,5 +68,32 @@ bool sphere::hit(const ray& r, double t_min, double t_max, hit_record& rec) cons
 
     return true;
 }
+/* Uniform over the solid angle of the sphere, so the pdf is 1/(solid angle) for every direction that hits it. */
+double sphere::pdf_value(const point3& o, const vec3& v) const {
+    hit_record rec;
+    if (!this->hit(ray(o,v), 0.001, infinity, rec))
+        return 0;
+
+    auto distance_squared = (center-o).length_squared();
+    /* From inside the sphere every direction hits it, cone sampling doesn't apply. */
+    if (distance_squared <= radius*radius)
+        return 0;
+
+    auto cos_theta_max = sqrt(1 - radius*radius/distance_squared);
+    auto solid_angle = 2*pi*(1-cos_theta_max);
+
+    return 1 / solid_angle;
+}
+
+vec3 sphere::random(const point3& o) const {
+    vec3 direction = center - o;
+    auto distance_squared = direction.length_squared();
+    if (distance_squared <= radius*radius)
+        return random_unit_vector();
+
+    onb uvw;
+    uvw.build_from_w(direction);
+    return uvw.local(random_to_sphere(radius, distance_squared));
+}
 
 #endif
\ No newline at end of file